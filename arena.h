@@ -0,0 +1,126 @@
+#pragma once
+#include <memory>
+#include "sqrt.h"
+
+// Per-thread bump allocator for short-lived numbers, e.g. everything a single request computes.
+// Allocation moves a pointer, deallocation of arena memory does nothing, and the memory comes back
+// all at once when ArenaScope rewinds. When the buffer is full it falls back to operator new.
+// Arena numbers must not be used after their scope ends, and must not be passed to other threads.
+class ThreadArena {
+public:
+	static constexpr size_t DefaultCapacity = 1 << 20;
+
+	static ThreadArena& Get() {
+		thread_local ThreadArena arena;
+		return arena;
+	}
+
+	void* Allocate(size_t bytes, size_t align) {
+		size_t offset = (m_offset + align - 1) & ~(align - 1);
+		if (offset + bytes > m_capacity) {
+			m_fallbacks++;
+			return ::operator new(bytes);
+		}
+		m_offset = offset + bytes;
+		return m_buffer.get() + offset;
+	}
+
+	void Deallocate(void* p) {
+		if (!Owns(p)) {
+			::operator delete(p);
+		}
+	}
+
+	bool Owns(const void* p) const {
+		const char* c = static_cast<const char*>(p);
+		return c >= m_buffer.get() && c < m_buffer.get() + m_capacity;
+	}
+
+	size_t Mark() const { return m_offset; }
+	void Rewind(size_t mark) { m_offset = mark; }
+
+	// can be changed only while nothing lives in the arena
+	void Reserve(size_t capacity) {
+		if (m_offset == 0 && capacity > m_capacity) {
+			m_buffer.reset(new char[capacity]);
+			m_capacity = capacity;
+		}
+	}
+
+	// gives a grown buffer back, same restriction as Reserve
+	void Shrink() {
+		if (m_offset == 0 && m_capacity > DefaultCapacity) {
+			m_buffer.reset(new char[DefaultCapacity]);
+			m_capacity = DefaultCapacity;
+		}
+	}
+
+	size_t Used() const { return m_offset; }
+	size_t Fallbacks() const { return m_fallbacks; }
+
+private:
+	ThreadArena() : m_buffer(new char[DefaultCapacity]), m_capacity(DefaultCapacity) {}
+
+	std::unique_ptr<char[]> m_buffer;
+	size_t m_capacity;
+	size_t m_offset = 0;
+	size_t m_fallbacks = 0;
+};
+
+// Stateless, so temporaries that cpp_int default constructs inside the algorithms use the arena too
+template<typename T>
+struct ArenaAllocator {
+	using value_type = T;
+
+	ArenaAllocator() = default;
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(ThreadArena::Get().Allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* p, size_t) {
+		ThreadArena::Get().Deallocate(p);
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>&) const { return true; }
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>&) const { return false; }
+};
+
+// Everything allocated in the arena after the scope starts is released when it ends
+class ArenaScope {
+public:
+	ArenaScope() : m_mark(ThreadArena::Get().Mark()) {}
+	~ArenaScope() { ThreadArena::Get().Rewind(m_mark); }
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	size_t m_mark;
+};
+
+// Long-lived inputs stay at the bottom of the thread arena, and per-call numbers use the space above them.
+// The arena grows by `inputBytes` for the lifetime of the scope and shrinks back to the default size after it
+class ArenaInputScope {
+public:
+	explicit ArenaInputScope(size_t inputBytes) : m_mark(ThreadArena::Get().Mark()) {
+		ThreadArena::Get().Reserve(inputBytes + ThreadArena::DefaultCapacity);
+	}
+	~ArenaInputScope() {
+		ThreadArena::Get().Rewind(m_mark);
+		ThreadArena::Get().Shrink();
+	}
+
+	ArenaInputScope(const ArenaInputScope&) = delete;
+	ArenaInputScope& operator=(const ArenaInputScope&) = delete;
+
+private:
+	size_t m_mark;
+};
+
+// std::pmr::polymorphic_allocator can't be used here, cpp_int_backend needs an assignable allocator
+using arenaInt = tArbInt<ArenaAllocator<limb_type>>;
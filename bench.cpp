@@ -1,10 +1,23 @@
 #include <iostream>
 #include "sqrt_bench.h"
 #include "oper_bench.h"
+#include "latency_bench.h"
+#include "cache_bench.h"
 
 int main(int argc, char **argv) {
+	// our own flag, google benchmark doesn't need to see it
+	std::string latencyCsv = "latency.csv";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.rfind("--latency_csv=", 0) == 0) {
+			latencyCsv = arg.substr(std::string("--latency_csv=").size());
+			std::copy(argv + i + 1, argv + argc, argv + i);
+			argc--;
+			break;
+		}
+	}
 	if (argc < 2) {
-		std::cout << "Usage sqrt_bench (sqrt|oper) [bench args]" << std::endl;
+		std::cout << "Usage sqrt_bench (sqrt|oper|dist|latency|cache) [--latency_csv=path] [bench args]" << std::endl;
 		return 0;
 	}
 	if (std::string(argv[1]) == "sqrt") {
@@ -13,10 +26,25 @@ int main(int argc, char **argv) {
 	else if (std::string(argv[1]) == "oper") {
 		RegisterOper();
 	}
+	else if (std::string(argv[1]) == "dist") {
+		RegisterDistribution();
+	}
+	else if (std::string(argv[1]) == "latency") {
+		RegisterLatency();
+	}
+	else if (std::string(argv[1]) == "cache") {
+		RegisterCache();
+	}
 	else {
-		std::cout << "Usage sqrt_bench (sqrt|oper) [bench args]" << std::endl;
+		std::cout << "Usage sqrt_bench (sqrt|oper|dist|latency|cache) [--latency_csv=path] [bench args]" << std::endl;
 		return 0;
 	}
 	benchmark::Initialize(&argc, argv);
 	benchmark::RunSpecifiedBenchmarks();
+	if (std::string(argv[1]) == "latency") {
+		WriteLatencyCsv(latencyCsv);
+	}
+#ifdef SQRT_INSTRUMENT
+	SqrtStats::Dump(std::cerr);
+#endif
 }
@@ -0,0 +1,205 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include "karatsubapr.h"
+#include "kernels.h"
+
+// Memoizing sqrt for workloads where the same radicands come back, e.g. squared distances between lattice points.
+// The cache is set-associative: a radicand can live only in one set of `Ways` entries, picked by its limb hash,
+// and the eviction policy chooses the victim inside that set. Sets are split between shards with their own mutex.
+// Entries keep radicand, root and remainder by value, so for fixed width tInt everything is inline in the set.
+
+// hashes the limbs as 64-bit words, trivial backends keep the value in a single wider or narrower limb
+template<typename Int>
+uint64_t LimbHash(const Int& value) {
+	const auto& b = value.backend();
+	using Limb = std::remove_cv_t<std::remove_pointer_t<decltype(b.limbs())>>;
+	uint64_t h = 0x9e3779b97f4a7c15ull ^ b.size() ^ (uint64_t(b.sign()) << 63);
+	for (size_t i = 0; i < b.size(); i++) {
+		for (size_t k = 0; k < sizeof(Limb); k += sizeof(uint64_t)) {
+			h = (h ^ static_cast<uint64_t>(b.limbs()[i] >> (8 * k))) * 0xff51afd7ed558ccdull;
+		}
+	}
+	// murmur3 finalizer, low bits select the set
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// least recently used way, with a per-set counter as the clock
+template<size_t Ways>
+struct LruEviction {
+	uint32_t stamps[Ways] = {};
+	uint32_t now = 0;
+
+	void Touch(size_t way) { stamps[way] = ++now; }
+
+	size_t Victim() const {
+		return std::min_element(stamps, stamps + Ways) - stamps;
+	}
+};
+
+// second chance: a way that was hit since the last sweep survives one more
+template<size_t Ways>
+struct ClockEviction {
+	bool referenced[Ways] = {};
+	size_t hand = 0;
+
+	void Touch(size_t way) { referenced[way] = true; }
+
+	size_t Victim() {
+		while (referenced[hand]) {
+			referenced[hand] = false;
+			hand = (hand + 1) % Ways;
+		}
+		size_t victim = hand;
+		hand = (hand + 1) % Ways;
+		return victim;
+	}
+};
+
+// no bookkeeping on hits, xorshift picks the victim
+template<size_t Ways>
+struct RandomEviction {
+	uint32_t state = 0x2545f491;
+
+	void Touch(size_t) {}
+
+	size_t Victim() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state % Ways;
+	}
+};
+
+// root and remainder with the same algorithms Karatsuba<T> uses
+template<typename T>
+struct CacheSqrtRem {
+	T operator()(const T& x, T& r) const {
+		return bmp_2_sqrt(x, r);
+	}
+};
+
+template<unsigned Bits>
+struct CacheSqrtRem<tInt<Bits>> {
+	tInt<Bits> operator()(const tInt<Bits>& x, tInt<Bits>& r) const {
+		if constexpr (Bits <= 256) {
+			return limb_sqrt(x, r);
+		}
+		else {
+			return bmp_2_sqrt(x, r);
+		}
+	}
+};
+
+struct SqrtCacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+
+	double HitRate() const {
+		return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / (hits + misses);
+	}
+};
+
+template<typename T, template<size_t> typename Eviction = LruEviction, size_t Ways = 4>
+class SqrtCache {
+public:
+	// capacity is rounded up to a power of two number of sets
+	explicit SqrtCache(size_t capacity, size_t shards = 16) {
+		m_sets = 1;
+		while (m_sets * Ways < capacity) {
+			m_sets <<= 1;
+		}
+		size_t shardCount = 1;
+		while (shardCount < shards && shardCount < m_sets) {
+			shardCount <<= 1;
+		}
+		m_shardMask = shardCount - 1;
+		m_shards.reset(new Shard[shardCount]);
+		m_entries.reset(new Set[m_sets]);
+	}
+
+	T Sqrt(const T& x) {
+		T r;
+		return SqrtRem(x, r);
+	}
+
+	T SqrtRem(const T& x, T& r) {
+		uint64_t hash = LimbHash(x);
+		Set& set = m_entries[hash & (m_sets - 1)];
+		Shard& shard = m_shards[hash & m_shardMask];
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			for (size_t way = 0; way < set.used; way++) {
+				Entry& e = set.ways[way];
+				if (e.hash == hash && e.key == x) {
+					shard.stats.hits++;
+					set.eviction.Touch(way);
+					r = e.rem;
+					return e.root;
+				}
+			}
+			shard.stats.misses++;
+		}
+		// computed without the lock, two threads missing on the same radicand both compute it
+		T s = CacheSqrtRem<T>()(x, r);
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		for (size_t way = 0; way < set.used; way++) {
+			if (set.ways[way].hash == hash && set.ways[way].key == x) {
+				return s;
+			}
+		}
+		size_t way = set.used;
+		if (way < Ways) {
+			set.used++;
+		}
+		else {
+			way = set.eviction.Victim();
+			shard.stats.evictions++;
+		}
+		set.ways[way] = Entry{hash, x, s, r};
+		set.eviction.Touch(way);
+		return s;
+	}
+
+	SqrtCacheStats Stats() const {
+		SqrtCacheStats total;
+		for (size_t i = 0; i <= m_shardMask; i++) {
+			std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+			total.hits += m_shards[i].stats.hits;
+			total.misses += m_shards[i].stats.misses;
+			total.evictions += m_shards[i].stats.evictions;
+		}
+		return total;
+	}
+
+	size_t Capacity() const { return m_sets * Ways; }
+
+private:
+	struct Entry {
+		uint64_t hash;
+		T key;
+		T root;
+		T rem;
+	};
+
+	struct Set {
+		Entry ways[Ways];
+		size_t used = 0;
+		Eviction<Ways> eviction;
+	};
+
+	// shards sit on their own cache lines, so threads locking different shards don't share one
+	struct alignas(64) Shard {
+		mutable std::mutex mutex;
+		SqrtCacheStats stats;
+	};
+
+	std::unique_ptr<Set[]> m_entries;
+	std::unique_ptr<Shard[]> m_shards;
+	size_t m_sets;
+	size_t m_shardMask;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include "sqrt_bench.h"
+#include "cache.h"
+
+// share of queries that take a radicand from a small hot pool, the rest are values seen once
+const std::vector<int64_t> RepeatPercents = {0, 50, 90, 99};
+
+constexpr size_t CacheQueries = 1 << 15;
+constexpr size_t CacheHotValues = 256;
+constexpr size_t CacheCapacity = 1024;
+
+template <typename T, size_t Length>
+std::vector<T> RepeatStream(size_t repeatPercent) {
+	std::vector<T> hot(CacheHotValues);
+	std::vector<T> fresh(CacheQueries);
+	FillRandom<T, cpp_int, Length>(hot, 1);
+	FillRandom<T, cpp_int, Length>(fresh, 2);
+	boost::random::mt19937 gen;
+	std::vector<T> stream(CacheQueries);
+	for (size_t i = 0; i < stream.size(); i++) {
+		stream[i] = gen() % 100 < repeatPercent ? hot[gen() % hot.size()] : fresh[i];
+	}
+	return stream;
+}
+
+template <typename T, size_t Length>
+void BenchUncachedSqrt(benchmark::State &state) {
+	std::vector<T> stream = RepeatStream<T, Length>(state.range(0));
+	size_t i = 0;
+	for (auto _ : state) {
+		T r = Karatsuba<T>().Sqrt(stream[i]);
+		benchmark::DoNotOptimize(r);
+		if (++i >= stream.size()) {
+			i = 0;
+		}
+	}
+}
+
+template <typename T, size_t Length, template <size_t> typename Eviction>
+void BenchCachedSqrt(benchmark::State &state) {
+	std::vector<T> stream = RepeatStream<T, Length>(state.range(0));
+	auto cache = std::make_unique<SqrtCache<T, Eviction>>(CacheCapacity);
+	SqrtCacheStats total;
+	size_t i = 0;
+	for (auto _ : state) {
+		T r = cache->Sqrt(stream[i]);
+		benchmark::DoNotOptimize(r);
+		if (++i >= stream.size()) {
+			// values seen once would become repeats on the next pass, so every pass starts cold
+			state.PauseTiming();
+			SqrtCacheStats stats = cache->Stats();
+			total.hits += stats.hits;
+			total.misses += stats.misses;
+			cache = std::make_unique<SqrtCache<T, Eviction>>(CacheCapacity);
+			i = 0;
+			state.ResumeTiming();
+		}
+	}
+	SqrtCacheStats stats = cache->Stats();
+	total.hits += stats.hits;
+	total.misses += stats.misses;
+	state.counters["hit_rate"] = total.HitRate();
+}
+
+template <typename T, size_t Length>
+void RegisterCacheOne(const std::string &name) {
+	std::string suffix = "_" + std::to_string(Length);
+	benchmark::RegisterBenchmark(("Uncached " + name + suffix).c_str(), BenchUncachedSqrt<T, Length>)
+		->ArgsProduct({RepeatPercents})->ArgName("repeat_pct");
+	benchmark::RegisterBenchmark(("Cached LRU " + name + suffix).c_str(), BenchCachedSqrt<T, Length, LruEviction>)
+		->ArgsProduct({RepeatPercents})->ArgName("repeat_pct");
+	benchmark::RegisterBenchmark(("Cached Clock " + name + suffix).c_str(), BenchCachedSqrt<T, Length, ClockEviction>)
+		->ArgsProduct({RepeatPercents})->ArgName("repeat_pct");
+	benchmark::RegisterBenchmark(("Cached Random " + name + suffix).c_str(), BenchCachedSqrt<T, Length, RandomEviction>)
+		->ArgsProduct({RepeatPercents})->ArgName("repeat_pct");
+}
+
+void RegisterCache() {
+	RegisterCacheOne<tInt<128>, 128>("Fixed");
+	RegisterCacheOne<tInt<256>, 256>("Fixed");
+	RegisterCacheOne<tInt<1024>, 1024>("Fixed");
+	RegisterCacheOne<tInt<8192>, 8192>("Fixed");
+	RegisterCacheOne<cpp_int, 1024>("Arbitrary");
+	RegisterCacheOne<cpp_int, 8192>("Arbitrary");
+}
@@ -0,0 +1,145 @@
+#pragma once
+// Counters and timers inside karatsuba_sqrt and bmp_2_karatsuba_sqrt, enabled with -DSQRT_INSTRUMENT.
+// Without it every macro expands to nothing, so the algorithm compiles exactly as before.
+#ifdef SQRT_INSTRUMENT
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+struct SqrtCounters {
+	static constexpr size_t MaxDepth = 64;
+
+	uint64_t calls = 0;
+	std::array<uint64_t, MaxDepth> depthCalls{};
+	uint64_t baseCases = 0;
+	uint64_t baseDown = 0; // `s64--` fixups in the base case
+	uint64_t baseUp = 0; // `s64++` fixups in the base case
+	uint64_t corrections = 0; // `r < q` fired
+	uint64_t rootFallbacks = 0; // root only mode couldn't decide the correction without squaring
+	uint64_t divideNs = 0;
+	uint64_t squareNs = 0;
+
+	void Add(const SqrtCounters& other) {
+		calls += other.calls;
+		for (size_t i = 0; i < MaxDepth; i++) {
+			depthCalls[i] += other.depthCalls[i];
+		}
+		baseCases += other.baseCases;
+		baseDown += other.baseDown;
+		baseUp += other.baseUp;
+		corrections += other.corrections;
+		rootFallbacks += other.rootFallbacks;
+		divideNs += other.divideNs;
+		squareNs += other.squareNs;
+	}
+};
+
+// every thread writes only its own counters, the registry is touched on thread start/exit and on dump
+class SqrtStats {
+public:
+	static SqrtCounters& Local() {
+		thread_local ThreadCounters counters;
+		return counters.value;
+	}
+
+	static size_t& Depth() {
+		thread_local size_t depth = 0;
+		return depth;
+	}
+
+	// sums counters of live threads and of threads that already exited
+	static SqrtCounters Collect() {
+		std::lock_guard<std::mutex> lock(Mutex());
+		SqrtCounters total = Retired();
+		for (auto* c : Live()) {
+			total.Add(*c);
+		}
+		return total;
+	}
+
+	static void Reset() {
+		std::lock_guard<std::mutex> lock(Mutex());
+		Retired() = SqrtCounters{};
+		for (auto* c : Live()) {
+			*c = SqrtCounters{};
+		}
+	}
+
+	static void Dump(std::ostream& out) {
+		SqrtCounters c = Collect();
+		out << "sqrt calls: " << c.calls << std::endl;
+		out << "base cases: " << c.baseCases << ", down fixups: " << c.baseDown << ", up fixups: " << c.baseUp << std::endl;
+		out << "r < q corrections: " << c.corrections << ", root only fallbacks: " << c.rootFallbacks << std::endl;
+		out << "divide_qr: " << c.divideNs << " ns, squaring: " << c.squareNs << " ns" << std::endl;
+		for (size_t i = 0; i < SqrtCounters::MaxDepth; i++) {
+			if (c.depthCalls[i] != 0) {
+				out << "depth " << i << ": " << c.depthCalls[i] << std::endl;
+			}
+		}
+	}
+
+private:
+	struct ThreadCounters {
+		SqrtCounters value;
+
+		ThreadCounters() {
+			std::lock_guard<std::mutex> lock(Mutex());
+			Live().push_back(&value);
+		}
+
+		~ThreadCounters() {
+			std::lock_guard<std::mutex> lock(Mutex());
+			Retired().Add(value);
+			Live().erase(std::find(Live().begin(), Live().end(), &value));
+		}
+	};
+
+	static std::mutex& Mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<SqrtCounters*>& Live() {
+		static std::vector<SqrtCounters*> live;
+		return live;
+	}
+
+	static SqrtCounters& Retired() {
+		static SqrtCounters retired;
+		return retired;
+	}
+};
+
+class SqrtDepthGuard {
+public:
+	SqrtDepthGuard() {
+		size_t depth = SqrtStats::Depth()++;
+		SqrtStats::Local().depthCalls[std::min(depth, SqrtCounters::MaxDepth - 1)]++;
+	}
+	~SqrtDepthGuard() { SqrtStats::Depth()--; }
+};
+
+class SqrtScopedTimer {
+public:
+	explicit SqrtScopedTimer(uint64_t& target) : m_target(target), m_start(std::chrono::steady_clock::now()) {}
+	~SqrtScopedTimer() {
+		m_target += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	uint64_t& m_target;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#define SQRT_COUNT(counter) (SqrtStats::Local().counter++)
+#define SQRT_DEPTH() SqrtDepthGuard sqrtDepthGuard
+#define SQRT_TIMER(timer) SqrtScopedTimer sqrtTimer_##timer(SqrtStats::Local().timer)
+#else
+#define SQRT_COUNT(counter)
+#define SQRT_DEPTH()
+#define SQRT_TIMER(timer)
+#endif
@@ -1,10 +1,13 @@
 #pragma once
 #include "sqrt.h"
+#include "instrument.h"
 #include <boost/multiprecision/gmp.hpp>
 
-template <class Integer>
+// with RootOnly the remainder isn't finished at this level, and `r` is left with garbage
+template <class Integer, bool RootOnly = false>
 Integer karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, Integer& q, size_t offset, size_t bits)
 {
+   SQRT_DEPTH();
 #ifndef BOOST_MP_NO_CONSTEXPR_DETECTION
    // std::sqrt is not constexpr by standard, so use this 
    if (BOOST_MP_IS_CONST_EVALUATED(bits)) {
@@ -33,14 +36,21 @@ Integer karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, Integer& q, siz
 #endif
    // we can calculate it faster with std::sqrt
    if (bits <= 64) {
+      SQRT_COUNT(baseCases);
       const uint64_t int32max = uint64_t((std::numeric_limits<uint32_t>::max)());
       uint64_t val = static_cast<uint64_t>(x >> offset);
       uint64_t s64 = static_cast<uint64_t>(std::sqrt(static_cast<long double>(val)));
       // converting to long double can loose some precision, and `sqrt` can give eps error, so we'll fix this
       // this is needed
-      while (s64 > int32max || s64 * s64 > val) s64--;
+      while (s64 > int32max || s64 * s64 > val) {
+         SQRT_COUNT(baseDown);
+         s64--;
+      }
       // in my tests this never fired, but theoretically this might be needed
-      while (s64 < int32max && (s64 + 1) * (s64 + 1) <= val) s64++;
+      while (s64 < int32max && (s64 + 1) * (s64 + 1) <= val) {
+         SQRT_COUNT(baseUp);
+         s64++;
+      }
       r = val - s64 * s64;
       return s64;
    }
@@ -56,7 +66,10 @@ Integer karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, Integer& q, siz
    t >>= (b + offset);
    t += r;
    s <<= 1;
-   divide_qr(t, s, q, r);
+   {
+      SQRT_TIMER(divideNs);
+      divide_qr(t, s, q, r);
+   }
    
    r <<= b;
    t ^= t;
@@ -67,10 +80,44 @@ Integer karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, Integer& q, siz
    r += t;
    s <<= (b - 1); // we already <<1 it before
    s += q;
-   q *= q;
+   if constexpr (RootOnly) {
+      // the root is s or s - 1, and we only need the sign of r - q * q to choose,
+      // so first compare the highest bits of r and q * q, it's enough almost always
+      if (q.is_zero()) {
+         return s;
+      }
+      size_t e = msb(q);
+      e = e > 30 ? e - 30 : 0;
+      t = q;
+      t >>= e;
+      uint64_t qt = static_cast<uint64_t>(t);
+      t = r;
+      t >>= 2 * e;
+      // r is in [rt * 2^2e, (rt + 1) * 2^2e) and q * q is in [qt^2 * 2^2e, (qt + 1)^2 * 2^2e)
+      if (!t.is_zero() && msb(t) >= 62) {
+         return s;
+      }
+      uint64_t rt = static_cast<uint64_t>(t);
+      if (rt < qt * qt) {
+         SQRT_COUNT(corrections);
+         return --s;
+      }
+      if (e == 0 || rt >= (qt + 1) * (qt + 1)) {
+         return s;
+      }
+      SQRT_COUNT(rootFallbacks);
+   }
+   {
+      SQRT_TIMER(squareNs);
+      q *= q;
+   }
 
+   if constexpr (RootOnly) {
+      return r < q ? --s : s;
+   }
    // we substract after, so it works for unsigned integers too
    if (r < q) {
+      SQRT_COUNT(corrections);
       t = s;
       t <<= 1;
       t--;
@@ -88,14 +135,22 @@ Integer kar_sqrt(const Integer& x, Integer& r)
       r = 0u;
       return 0u;
    }
+   SQRT_COUNT(calls);
    Integer t{};
    Integer q{};
    return karatsuba_sqrt(x, r, t, q, 0, msb(x) + 1);
 }
 
+// skips the remainder at the top level, where it costs the biggest squaring
 template <class Integer>
 Integer kar_sqrt(const Integer& x)
 {
-   Integer r(0);
-   return kar_sqrt(x, r);
+   if (x.is_zero()) {
+      return 0u;
+   }
+   SQRT_COUNT(calls);
+   Integer r{};
+   Integer t{};
+   Integer q{};
+   return karatsuba_sqrt<Integer, true>(x, r, t, q, 0, msb(x) + 1);
 }
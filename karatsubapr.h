@@ -1,5 +1,6 @@
 #pragma once
 #include "sqrt.h"
+#include "instrument.h"
 #include <boost/multiprecision/gmp.hpp>
 
 template <class Integer>
@@ -82,6 +83,7 @@ Integer bmp_sqrt(const Integer& x)
 template <class Integer>
 Integer bmp_2_karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, size_t bits)
 {
+   SQRT_DEPTH();
 #ifndef BOOST_MP_NO_CONSTEXPR_DETECTION
    // std::sqrt is not constexpr by standard, so use this 
    if (BOOST_MP_IS_CONST_EVALUATED(bits)) {
@@ -108,14 +110,21 @@ Integer bmp_2_karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, size_t bi
 #endif
    // we can calculate it faster with std::sqrt
    if (bits <= 64) {
+      SQRT_COUNT(baseCases);
       const uint64_t int32max = uint64_t((std::numeric_limits<uint32_t>::max)());
       uint64_t val = static_cast<uint64_t>(x);
       uint64_t s64 = static_cast<uint64_t>(std::sqrt(static_cast<long double>(val)));
       // converting to long double can loose some precision, and `sqrt` can give eps error, so we'll fix this
       // this is needed
-      while (s64 > int32max || s64 * s64 > val) s64--;
+      while (s64 > int32max || s64 * s64 > val) {
+         SQRT_COUNT(baseDown);
+         s64--;
+      }
       // in my tests this never fired, but theoretically this might be needed
-      while (s64 < int32max && (s64 + 1) * (s64 + 1) <= val) s64++;
+      while (s64 < int32max && (s64 + 1) * (s64 + 1) <= val) {
+         SQRT_COUNT(baseUp);
+         s64++;
+      }
       r = val - s64 * s64;
       return s64;
    }
@@ -132,7 +141,10 @@ Integer bmp_2_karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, size_t bi
    t >>= b;
    t += r;
    s <<= 1;
-   divide_qr(t, s, q, r);
+   {
+      SQRT_TIMER(divideNs);
+      divide_qr(t, s, q, r);
+   }
    r <<= b;
    t = 0u;
    bit_set(t, b);
@@ -141,9 +153,13 @@ Integer bmp_2_karatsuba_sqrt(const Integer& x, Integer& r, Integer& t, size_t bi
    r += t;
    s <<= (b - 1); // we already <<1 it before
    s += q;
-   q *= q;
+   {
+      SQRT_TIMER(squareNs);
+      q *= q;
+   }
    // we substract after, so it works for unsigned integers too
    if (r < q) {
+      SQRT_COUNT(corrections);
       t = s;
       t <<= 1;
       t--;
@@ -161,6 +177,7 @@ Integer bmp_2_sqrt(const Integer& x, Integer& r)
       r = 0u;
       return 0u;
    }
+   SQRT_COUNT(calls);
    Integer t;
    return bmp_2_karatsuba_sqrt(x, r, t, msb(x) + 1);
 }
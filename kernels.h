@@ -0,0 +1,266 @@
+#pragma once
+#include "sqrt.h"
+
+// Square roots with remainder of 1-4 limb numbers, done in registers with 64-bit limbs and unsigned __int128.
+// Larger ones are one Karatsuba step over the smaller ones, see karatsuba_sqrt and
+// https://hal.inria.fr/file/index/docid/72854/filename/RR-3805.pdf
+
+static_assert(sizeof(limb_type) == sizeof(uint64_t), "limb kernels expect 64-bit limbs");
+
+using uint128 = unsigned __int128;
+
+// remainder of a 4-limb root can take 129 bits
+struct uint192 {
+	uint128 lo;
+	uint64_t hi;
+};
+
+inline void add192(uint192& a, uint128 lo, uint64_t hi) {
+	uint128 t = a.lo + lo;
+	a.hi += hi + (t < a.lo);
+	a.lo = t;
+}
+
+inline void sub192(uint192& a, uint128 lo, uint64_t hi) {
+	uint128 t = a.lo - lo;
+	a.hi -= hi + (a.lo < lo);
+	a.lo = t;
+}
+
+inline bool less192(const uint192& a, uint128 lo, uint64_t hi) {
+	return a.hi < hi || (a.hi == hi && a.lo < lo);
+}
+
+inline uint64_t sqrtrem_1(uint64_t x, uint64_t& r) {
+	const uint64_t int32max = uint64_t((std::numeric_limits<uint32_t>::max)());
+	uint64_t s = static_cast<uint64_t>(std::sqrt(static_cast<long double>(x)));
+	// converting to long double can loose some precision, and `sqrt` can give eps error, so we'll fix this
+	while (s > int32max || s * s > x) s--;
+	while (s < int32max && (s + 1) * (s + 1) <= x) s++;
+	r = x - s * s;
+	return s;
+}
+
+inline uint64_t sqrtrem_2(uint128 x, uint128& r) {
+	uint64_t hi = static_cast<uint64_t>(x >> 64);
+	if (hi == 0) {
+		uint64_t r64;
+		uint64_t s = sqrtrem_1(static_cast<uint64_t>(x), r64);
+		r = r64;
+		return s;
+	}
+	// the step needs the highest limb >= 2^62, shift by an even amount so the root shifts by half of it
+	unsigned shift = __builtin_clzll(hi) & ~1u;
+	uint128 n = x << shift;
+	uint64_t r1;
+	uint64_t s1 = sqrtrem_1(static_cast<uint64_t>(n >> 64), r1);
+	uint64_t low = static_cast<uint64_t>(n);
+	uint64_t a1 = low >> 32;
+	uint64_t a0 = low & 0xffffffffu;
+
+	// (r1 * 2^32 + a1) / (2 * s1) without overflowing 64 bits
+	uint64_t half = (r1 << 31) | (a1 >> 1);
+	uint64_t q = half / s1;
+	uint64_t u = 2 * (half % s1) + (a1 & 1);
+	// q can be 2^32, then s1 * 2^32 + q may overflow, so take one less and maybe fix it up below
+	if (q >> 32) {
+		q--;
+		u += 2 * s1;
+	}
+	uint64_t s = (s1 << 32) + q;
+	uint128 rem = (uint128(u) << 32) + a0;
+	uint128 q2 = uint128(q) * q;
+	// we substract after, so it works for unsigned integers too
+	if (rem < q2) {
+		rem += 2 * uint128(s) - 1;
+		s--;
+	}
+	rem -= q2;
+	if (rem > 2 * uint128(s)) {
+		rem -= 2 * uint128(s) + 1;
+		s++;
+	}
+
+	if (shift != 0) {
+		s >>= shift / 2;
+		rem = x - uint128(s) * s;
+	}
+	r = rem;
+	return s;
+}
+
+// root of a3:a2:a1:a0 with a3 >= 2^62
+inline uint128 sqrtrem_4_normalized(uint64_t a3, uint64_t a2, uint64_t a1, uint64_t a0, uint192& r) {
+	uint128 r1;
+	uint64_t s1 = sqrtrem_2((uint128(a3) << 64) | a2, r1);
+
+	// (r1 * 2^64 + a1) / (2 * s1), r1 takes up to 65 bits, so halve both
+	uint128 half = (r1 << 63) | (a1 >> 1);
+	uint128 q = half / s1;
+	uint128 u = 2 * (half % s1) + (a1 & 1);
+	if (q >> 64) {
+		q--;
+		u += 2 * uint128(s1);
+	}
+	uint128 s = (uint128(s1) << 64) | static_cast<uint64_t>(q);
+	uint128 q2 = q * q;
+	// u * 2^64 + a0
+	uint192 rem{(u << 64) | a0, static_cast<uint64_t>(u >> 64)};
+	if (less192(rem, q2, 0)) {
+		add192(rem, s << 1, static_cast<uint64_t>(s >> 127));
+		sub192(rem, 1, 0);
+		s--;
+	}
+	sub192(rem, q2, 0);
+	// rem > 2 * s
+	if (!less192(rem, (s << 1) + 1, static_cast<uint64_t>(s >> 127))) {
+		sub192(rem, (s << 1) + 1, static_cast<uint64_t>(s >> 127));
+		s++;
+	}
+	r = rem;
+	return s;
+}
+
+// x - s^2 modulo 2^192, it's exact when s is the root of x
+inline uint192 remainder_4(const uint64_t* x, uint128 s) {
+	uint64_t sl = static_cast<uint64_t>(s);
+	uint64_t sh = static_cast<uint64_t>(s >> 64);
+	uint128 mid = uint128(sh) * sl;
+	uint192 sq{uint128(sl) * sl, 0};
+	add192(sq, mid << 64, static_cast<uint64_t>(mid >> 64));
+	add192(sq, mid << 64, static_cast<uint64_t>(mid >> 64));
+	add192(sq, 0, sh * sh);
+	uint192 r{(uint128(x[1]) << 64) | x[0], x[2]};
+	sub192(r, sq.lo, sq.hi);
+	return r;
+}
+
+// shifts a3:a2:a1:a0 left by `shift` bits (< 64) and takes the root
+inline uint128 sqrtrem_4_shifted(const uint64_t* x, uint64_t a3, uint64_t a2, uint64_t a1, uint64_t a0, unsigned shift, unsigned extra, uint192& r) {
+	if (shift != 0) {
+		a3 = (a3 << shift) | (a2 >> (64 - shift));
+		a2 = (a2 << shift) | (a1 >> (64 - shift));
+		a1 = (a1 << shift) | (a0 >> (64 - shift));
+		a0 <<= shift;
+	}
+	uint128 s = sqrtrem_4_normalized(a3, a2, a1, a0, r);
+	unsigned total = shift + extra;
+	if (total != 0) {
+		s >>= total / 2;
+		r = remainder_4(x, s);
+	}
+	return s;
+}
+
+inline uint128 sqrtrem_3(const uint64_t* x, uint192& r) {
+	if (x[2] == 0) {
+		uint128 r128;
+		uint128 s = sqrtrem_2((uint128(x[1]) << 64) | x[0], r128);
+		r = uint192{r128, 0};
+		return s;
+	}
+	// work with x * 2^64, its root is the root of x times 2^32
+	uint64_t x4[4] = {x[0], x[1], x[2], 0};
+	return sqrtrem_4_shifted(x4, x[2], x[1], x[0], 0, __builtin_clzll(x[2]) & ~1u, 64, r);
+}
+
+inline uint128 sqrtrem_4(const uint64_t* x, uint192& r) {
+	if (x[3] == 0) {
+		return sqrtrem_3(x, r);
+	}
+	return sqrtrem_4_shifted(x, x[3], x[2], x[1], x[0], __builtin_clzll(x[3]) & ~1u, 0, r);
+}
+
+template<>
+struct MathSqrt<uint128> {
+	uint128 Sqrt(uint128 value) {
+		uint128 r;
+		return sqrtrem_2(value, r);
+	}
+
+	uint128 SqrtRem(uint128 value, uint128& r) {
+		return sqrtrem_2(value, r);
+	}
+};
+
+#if defined(__clang__) && defined(__BITINT_MAXWIDTH__)
+template<unsigned N>
+struct MathSqrt<unsigned _BitInt(N)> {
+	using Int = unsigned _BitInt(N);
+	static_assert(N <= 256, "limb kernels handle at most 4 limbs");
+
+	Int Sqrt(Int value) {
+		Int r;
+		return SqrtRem(value, r);
+	}
+
+	Int SqrtRem(Int value, Int& r) {
+		if constexpr (N <= 64) {
+			uint64_t r64;
+			Int s = sqrtrem_1(static_cast<uint64_t>(value), r64);
+			r = r64;
+			return s;
+		}
+		else if constexpr (N <= 128) {
+			uint128 r128;
+			Int s = sqrtrem_2(static_cast<uint128>(value), r128);
+			r = r128;
+			return s;
+		}
+		else {
+			uint64_t a[4] = {0, 0, 0, 0};
+			for (unsigned i = 0; i * 64 < N; i++) {
+				a[i] = static_cast<uint64_t>(value >> (i * 64));
+			}
+			uint192 r192;
+			Int s = sqrtrem_4(a, r192);
+			r = static_cast<Int>(r192.lo) | (static_cast<Int>(r192.hi) << 128);
+			return s;
+		}
+	}
+};
+#endif
+
+template<unsigned Bits>
+void set_limbs(tInt<Bits>& value, const uint192& v) {
+	constexpr unsigned limbs = (Bits + 63) / 64;
+	uint64_t w[3] = {static_cast<uint64_t>(v.lo), static_cast<uint64_t>(v.lo >> 64), v.hi};
+	value.backend().resize(std::min(3u, limbs), std::min(3u, limbs));
+	for (unsigned i = 0; i < std::min(3u, limbs); i++) {
+		value.backend().limbs()[i] = w[i];
+	}
+	value.backend().normalize();
+}
+
+// sqrt for tInt up to 256 bits without generic cpp_int arithmetic
+template<unsigned Bits>
+tInt<Bits> limb_sqrt(const tInt<Bits>& x, tInt<Bits>& r) {
+	static_assert(Bits <= 256, "limb kernels handle at most 4 limbs");
+	if constexpr (Bits <= 64) {
+		uint64_t r64;
+		uint64_t s = sqrtrem_1(x.template convert_to<uint64_t>(), r64);
+		r = r64;
+		return tInt<Bits>(s);
+	}
+	else if constexpr (Bits <= 128) {
+		// these backends keep the value in a single unsigned __int128
+		uint128 r128;
+		uint64_t s = sqrtrem_2(x.template convert_to<uint128>(), r128);
+		r = tInt<Bits>(r128);
+		return tInt<Bits>(s);
+	}
+	else {
+		uint64_t a[4] = {0, 0, 0, 0};
+		std::copy(x.backend().limbs(), x.backend().limbs() + x.backend().size(), a);
+		uint192 r192;
+		uint128 s = sqrtrem_4(a, r192);
+		set_limbs(r, r192);
+		return tInt<Bits>(s);
+	}
+}
+
+template<unsigned Bits>
+tInt<Bits> limb_sqrt(const tInt<Bits>& x) {
+	tInt<Bits> r;
+	return limb_sqrt(x, r);
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <x86intrin.h>
+#include "sqrt_bench.h"
+
+// rdtsc can't move before the preceding loads and nothing after it can start earlier
+inline uint64_t TscBegin() {
+	_mm_lfence();
+	uint64_t t = __rdtsc();
+	_mm_lfence();
+	return t;
+}
+
+// rdtscp waits for the measured code to finish, lfence keeps the following code out of the interval
+inline uint64_t TscEnd() {
+	unsigned aux;
+	uint64_t t = __rdtscp(&aux);
+	_mm_lfence();
+	return t;
+}
+
+// cost of an empty TscBegin/TscEnd pair, subtracted from every sample
+inline uint64_t TscOverhead() {
+	static const uint64_t overhead = [] {
+		uint64_t best = std::numeric_limits<uint64_t>::max();
+		for (int i = 0; i < 100000; i++) {
+			uint64_t t0 = TscBegin();
+			uint64_t t1 = TscEnd();
+			best = std::min(best, t1 - t0);
+		}
+		return best;
+	}();
+	return overhead;
+}
+
+inline double TscPerNs() {
+	static const double perNs = [] {
+		auto start = std::chrono::steady_clock::now();
+		uint64_t t0 = TscBegin();
+		while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50));
+		uint64_t t1 = TscEnd();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		return (t1 - t0) / elapsed.count();
+	}();
+	return perNs;
+}
+
+// HDR-style histogram: values below 2^SubBits are exact, larger ones are kept in
+// 2^(SubBits-1) linear buckets per power of two, so the relative error is below 1/64
+class LatencyHistogram {
+public:
+	static constexpr size_t SubBits = 7;
+	static constexpr uint64_t SubCount = uint64_t(1) << SubBits;
+	static constexpr uint64_t HalfCount = SubCount / 2;
+
+	LatencyHistogram() : m_counts(SubCount + (64 - SubBits + 1) * HalfCount, 0) {}
+
+	void Record(uint64_t value) {
+		m_counts[Index(value)]++;
+		m_total++;
+		m_max = std::max(m_max, value);
+	}
+
+	// highest value of the bucket where the `q` quantile falls
+	uint64_t Quantile(double q) const {
+		if (m_total == 0) {
+			return 0;
+		}
+		uint64_t rank = static_cast<uint64_t>(q * (m_total - 1)) + 1;
+		uint64_t seen = 0;
+		for (size_t i = 0; i < m_counts.size(); i++) {
+			seen += m_counts[i];
+			if (seen >= rank) {
+				return std::min(m_max, UpperBound(i));
+			}
+		}
+		return m_max;
+	}
+
+	uint64_t Max() const { return m_max; }
+	uint64_t Count() const { return m_total; }
+
+private:
+	static size_t Index(uint64_t value) {
+		if (value < SubCount) {
+			return value;
+		}
+		size_t shift = 63 - __builtin_clzll(value) - (SubBits - 1);
+		return SubCount + (shift - 1) * HalfCount + ((value >> shift) - HalfCount);
+	}
+
+	static uint64_t UpperBound(size_t index) {
+		if (index < SubCount) {
+			return index;
+		}
+		size_t shift = (index - SubCount) / HalfCount + 1;
+		uint64_t sub = (index - SubCount) % HalfCount + HalfCount;
+		return ((sub + 1) << shift) - 1;
+	}
+
+	std::vector<uint64_t> m_counts;
+	uint64_t m_total = 0;
+	uint64_t m_max = 0;
+};
+
+struct LatencyRow {
+	uint64_t count;
+	double p50, p90, p99, p999, max;
+};
+
+// benchmark functions are rerun while google benchmark picks the iteration count, only the last run is kept
+std::map<std::string, LatencyRow> LatencyRows;
+
+static void ReportLatency(benchmark::State &state, const std::string &name, const LatencyHistogram &hist) {
+	double perNs = TscPerNs();
+	LatencyRow row{hist.Count(), hist.Quantile(0.5) / perNs, hist.Quantile(0.9) / perNs, hist.Quantile(0.99) / perNs,
+		hist.Quantile(0.999) / perNs, hist.Max() / perNs};
+	state.counters["p50_ns"] = row.p50;
+	state.counters["p90_ns"] = row.p90;
+	state.counters["p99_ns"] = row.p99;
+	state.counters["p999_ns"] = row.p999;
+	state.counters["max_ns"] = row.max;
+	LatencyRows[name] = row;
+}
+
+void WriteLatencyCsv(const std::string &path) {
+	std::ofstream out(path);
+	out << "name,count,p50_ns,p90_ns,p99_ns,p999_ns,max_ns" << std::endl;
+	for (const auto& [name, row] : LatencyRows) {
+		out << '"' << name << "\"," << row.count << "," << row.p50 << "," << row.p90 << "," << row.p99 << ","
+			<< row.p999 << "," << row.max << std::endl;
+	}
+}
+
+template <size_t Bits, size_t Length, template <typename> typename Sqrt>
+void BenchSqrtLatency(benchmark::State &state, const std::string &name) {
+	size_t inputs = state.range(0);
+	tAlignedVector<tInt<Bits>> vec(inputs);
+	tAlignedVector<tInt<Bits>> res(inputs);
+	FillRandom<tInt<Bits>, cpp_int, Length>(vec);
+	LatencyHistogram hist;
+	uint64_t overhead = TscOverhead();
+	size_t i = 0;
+	for (auto _ : state) {
+		uint64_t t0 = TscBegin();
+		res[i] = Sqrt<tInt<Bits>>().Sqrt(vec[i]);
+		uint64_t t1 = TscEnd();
+		hist.Record(t1 - t0 > overhead ? t1 - t0 - overhead : 0);
+		if (++i >= vec.size()) {
+			i = 0;
+		}
+	}
+	BENCHMARK_UNUSED(res);
+	ReportLatency(state, name, hist);
+}
+
+template <typename T, size_t Length, typename F>
+void BenchArbitraryLatency(benchmark::State &state, const std::string &name, F f) {
+	size_t inputs = state.range(0);
+	std::vector<T> vec(inputs);
+	std::vector<T> res(inputs);
+	if constexpr (std::is_same<T, mpz_int>::value) {
+		FillRandom<T, mpz_int, Length>(vec);
+	}
+	else {
+		FillRandom<T, cpp_int, Length>(vec);
+	}
+	LatencyHistogram hist;
+	uint64_t overhead = TscOverhead();
+	size_t i = 0;
+	for (auto _ : state) {
+		uint64_t t0 = TscBegin();
+		res[i] = f(vec[i]);
+		uint64_t t1 = TscEnd();
+		hist.Record(t1 - t0 > overhead ? t1 - t0 - overhead : 0);
+		if (++i >= vec.size()) {
+			i = 0;
+		}
+	}
+	ReportLatency(state, name, hist);
+}
+
+// single samples are small, so the L2 working set keeps DRAM misses out of the tail
+const std::vector<size_t> LatencyWorkingSet = {256 << 10};
+
+template <size_t Bits, template <typename> typename Sqrt>
+void RegisterLatencyOne(const std::string &name) {
+	std::string testName = name + "_" + std::to_string(Bits) + "_" + std::to_string(Bits);
+	auto b = benchmark::RegisterBenchmark(testName.c_str(), [testName](benchmark::State &state) {
+		BenchSqrtLatency<Bits, Bits, Sqrt>(state, testName);
+	});
+	ApplyWorkingSets(b, FixedInputBytes<Bits>(), LatencyWorkingSet);
+}
+
+template <template <typename> typename Sqrt, size_t... T>
+void RegisterLatencyIter(const std::string &name) {
+	(RegisterLatencyOne<T, Sqrt>(name), ...);
+}
+
+template <typename T, size_t Length, typename F>
+void RegisterArbitraryLatencyOne(const std::string &name, F f) {
+	std::string testName = name + "_" + std::to_string(Length);
+	auto b = benchmark::RegisterBenchmark(testName.c_str(), [testName, f](benchmark::State &state) {
+		BenchArbitraryLatency<T, Length, F>(state, testName, f);
+	});
+	ApplyWorkingSets(b, ArbitraryInputBytes<T, Length>(), LatencyWorkingSet);
+}
+
+template <typename T, typename F, size_t... Lengths>
+void RegisterArbitraryLatencyIter(const std::string &name, F f) {
+	(RegisterArbitraryLatencyOne<T, Lengths, F>(name, f), ...);
+}
+
+template <typename T, typename F>
+void RegisterArbitraryLatency(const std::string &name, F f) {
+	RegisterArbitraryLatencyIter<T, F, 64, 128, 256, 512, 1024, 8192>(name, f);
+}
+
+void RegisterLatency() {
+	RegisterLatencyIter<BoostSqrt, 64, 128, 256, 512, 1024, 8192>("Boost Fixed Latency");
+	RegisterLatencyIter<NewtonSqrt, 64, 128, 256, 512, 1024, 8192>("Newton Fixed Latency");
+	RegisterLatencyIter<Karatsuba, 64, 128, 256, 512, 1024, 8192>("Final Fixed Latency");
+	RegisterArbitraryLatency<cpp_int>("Boost Arbitrary Latency", [](const auto& v) { return sqrt(v); });
+	RegisterArbitraryLatency<cpp_int>("Final Arbitrary Latency", [](const auto& v) { return bmp_2_sqrt(v); });
+	RegisterArbitraryLatency<mpz_int>("GMP Arbitrary Latency", [](const auto& v) { return sqrt(v); });
+}
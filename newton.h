@@ -1,5 +1,6 @@
 #pragma once
 #include "sqrt.h"
+#include "kernels.h"
 
 template<typename T>
 struct NewtonSqrt {};
@@ -18,6 +19,20 @@ struct NewtonSqrt<tInt<64>> {
 	}
 };
 
+template<>
+struct NewtonSqrt<tInt<128>> {
+	tInt<128> Sqrt(const tInt<128>& value) {
+		return limb_sqrt(value);
+	}
+};
+
+template<>
+struct NewtonSqrt<tInt<256>> {
+	tInt<256> Sqrt(const tInt<256>& value) {
+		return limb_sqrt(value);
+	}
+};
+
 template<unsigned Bits>
 struct NewtonSqrt<tInt<Bits>> {
 	tInt<Bits> Sqrt(tInt<Bits> const& value) {
@@ -37,8 +52,9 @@ struct NewtonSqrt<tInt<Bits>> {
 
 private:
 	tInt<Bits> sqrt(tInt<Bits> const& value) {
+		// keep at most 64 bits, and an even shift, so the estimate is never 0 and scales back exactly
 		size_t shift = msb(value);
-		shift = shift < 64 ? 0 : shift - 64;
+		shift = shift < 64 ? 0 : (shift - 63 + 1) & ~size_t(1);
 		tInt<Bits> res(MathSqrt<uint64_t>().Sqrt((value >> shift).template convert_to<uint64_t>()));
 		res <<= shift / 2;
 		bool decreased = false; // newton approximation can get stuck in +-1 cycle
@@ -1,9 +1,15 @@
+#include <optional>
 #include <benchmark/benchmark.h>
 #include <boost/multiprecision/gmp.hpp>
 #include "karatsuba.h"
+#include "arena.h"
 
 template<typename T, size_t Left, size_t Right, typename F>
 void BenchOper(benchmark::State &state, F f) {
+    std::optional<ArenaInputScope> inputScope;
+    if constexpr (std::is_same<T, arenaInt>::value) {
+        inputScope.emplace(2 * 10000 * (sizeof(T) + Left / 8));
+    }
     std::vector<T> a(10000);
     std::vector<T> b(10000);
 	std::vector<T> res(10000);
@@ -17,7 +23,14 @@ void BenchOper(benchmark::State &state, F f) {
     }
 	size_t i = 0;
     for (auto _ : state) {
-        res[i] = f(a[i], b[i]);
+        if constexpr (std::is_same<T, arenaInt>::value) {
+            ArenaScope scope;
+            T r = f(a[i], b[i]);
+            benchmark::DoNotOptimize(r);
+        }
+        else {
+            res[i] = f(a[i], b[i]);
+        }
 		if (++i >= res.size()) {
 			i = 0;
 		}
@@ -105,5 +118,7 @@ void RegisterOper() {
 	RegisterBoost<1>("Boost kar: Compute", [](const auto& a, const auto& b) { return Compute<true>(a, b); });
 	RegisterArbitrary<cpp_int, 1>("Boost arbitrary: Compute", [](const auto& a, const auto& b) { return Compute<false>(a, b); });
 	RegisterArbitrary<cpp_int, 1>("Boost kar arbitrary: Compute", [](const auto& a, const auto& b) { return Compute<true>(a, b); });
+	RegisterArbitrary<arenaInt, 1>("Boost arena arbitrary: Compute", [](const auto& a, const auto& b) { return Compute<false>(a, b); });
+	RegisterArbitrary<arenaInt, 1>("Boost kar arena arbitrary: Compute", [](const auto& a, const auto& b) { return Compute<true>(a, b); });
 	RegisterArbitrary<mpz_int, 1>("GMP: Compute", [](const auto& a, const auto& b) { return Compute<false>(a, b); });
 }
\ No newline at end of file
@@ -5,12 +5,18 @@
 #include <algorithm>
 #include <cinttypes>
 #include <cmath>
+#include <string>
+#include <vector>
 
 using namespace boost::multiprecision;
 
 template<size_t Bits>
 using tInt = number<cpp_int_backend<Bits, Bits, signed_magnitude, unchecked, void>>;
 
+// arbitrary precision like cpp_int, with limbs from a custom allocator
+template<typename Allocator>
+using tArbInt = number<cpp_int_backend<0, 0, signed_magnitude, unchecked, Allocator>>;
+
 template<typename T>
 struct MathSqrt {};
 
@@ -37,10 +43,108 @@ struct MathSqrt<uint64_t> {
 	}
 };
 
-template<typename Int, typename Backend, size_t Length>
-void FillRandom(std::vector<Int>& v) {
-    boost::random::independent_bits_engine<boost::random::mt19937, Length, Backend> gen;
+template<typename Int, typename Backend, size_t Length, typename Alloc>
+void FillRandom(std::vector<Int, Alloc>& v, uint32_t seed = boost::random::mt19937::default_seed) {
+    boost::random::independent_bits_engine<boost::random::mt19937, Length, Backend> gen(seed);
     for (auto &i : v) {
         i = Int(gen());
     }
 }
+
+// Inputs that take different branches in the algorithms, not only uniform random bits
+enum class Distribution {
+	Uniform,
+	PerfectSquare,
+	SquarePlusOne,
+	SquareMinusOne,
+	PowerOfTwo,
+	SparseTop, // only the highest bit is set in the top limb (top half of the limb for single limb values)
+	PastLimb, // a few bits past the last full limb (or half limb for single limb values)
+	Mixed, // mostly short values with a long tail, like production inputs
+};
+
+const std::vector<Distribution> AllDistributions = {
+	Distribution::Uniform,
+	Distribution::PerfectSquare,
+	Distribution::SquarePlusOne,
+	Distribution::SquareMinusOne,
+	Distribution::PowerOfTwo,
+	Distribution::SparseTop,
+	Distribution::PastLimb,
+	Distribution::Mixed,
+};
+
+inline std::string DistributionName(Distribution dist) {
+	switch (dist) {
+	case Distribution::Uniform: return "uniform";
+	case Distribution::PerfectSquare: return "square";
+	case Distribution::SquarePlusOne: return "square+1";
+	case Distribution::SquareMinusOne: return "square-1";
+	case Distribution::PowerOfTwo: return "pow2";
+	case Distribution::SparseTop: return "sparse_top";
+	case Distribution::PastLimb: return "past_limb";
+	case Distribution::Mixed: return "mixed";
+	}
+	return "";
+}
+
+template<typename Int, typename Backend, size_t Length, typename Alloc>
+void FillDistribution(std::vector<Int, Alloc>& v, Distribution dist) {
+	if (dist == Distribution::Uniform) {
+		FillRandom<Int, Backend, Length>(v);
+		return;
+	}
+	constexpr size_t limbBits = 64;
+	// a single limb value has no limb boundary below it, so split it in halves instead
+	constexpr size_t wordBits = Length <= limbBits ? Length / 2 : limbBits;
+	constexpr size_t lastWord = (Length - 1) / wordBits * wordBits;
+	boost::random::independent_bits_engine<boost::random::mt19937, Length, Backend> gen;
+	boost::random::independent_bits_engine<boost::random::mt19937, Length / 2, Backend> half;
+	boost::random::mt19937 rnd;
+	// keeps `bits` lowest bits of a random value and sets the highest of them
+	auto withBits = [&gen](size_t bits) {
+		Backend x = gen();
+		x &= (Backend(1) << bits) - 1;
+		bit_set(x, bits - 1);
+		return x;
+	};
+	for (auto &i : v) {
+		Backend x;
+		switch (dist) {
+		case Distribution::PerfectSquare:
+		case Distribution::SquarePlusOne:
+		case Distribution::SquareMinusOne:
+			x = half();
+			if (dist == Distribution::SquareMinusOne && x.is_zero()) {
+				x = 1u;
+			}
+			x *= x;
+			if (dist == Distribution::SquarePlusOne) x++;
+			if (dist == Distribution::SquareMinusOne) x--;
+			break;
+		case Distribution::PowerOfTwo:
+			x = 0u;
+			bit_set(x, boost::random::uniform_int_distribution<size_t>(0, Length - 1)(rnd));
+			break;
+		case Distribution::SparseTop:
+			x = gen();
+			x &= (Backend(1) << lastWord) - 1;
+			bit_set(x, Length - 1);
+			break;
+		case Distribution::PastLimb:
+			x = withBits(std::min(Length, lastWord + boost::random::uniform_int_distribution<size_t>(1, 8)(rnd)));
+			break;
+		case Distribution::Mixed: {
+			// half of values are in the lowest quarter of lengths, and only 5% are longer than 3/4
+			size_t p = boost::random::uniform_int_distribution<size_t>(0, 99)(rnd);
+			size_t quarter = p < 50 ? 0 : p < 80 ? 1 : p < 95 ? 2 : 3;
+			size_t from = std::max<size_t>(1, quarter * Length / 4);
+			x = withBits(boost::random::uniform_int_distribution<size_t>(from, (quarter + 1) * Length / 4)(rnd));
+			break;
+		}
+		default:
+			x = gen();
+		}
+		i = Int(x);
+	}
+}
@@ -1,9 +1,17 @@
+#pragma once
+#include <algorithm>
+#include <numeric>
+#include <optional>
+#include <random>
 #include <benchmark/benchmark.h>
 #include <boost/multiprecision/gmp.hpp>
 #include <boost/random.hpp>
+#include <boost/align/aligned_allocator.hpp>
 #include "newton.h"
 #include "karatsuba.h"
 #include "karatsubapr.h"
+#include "kernels.h"
+#include "arena.h"
 
 static bool CheckSqrtBench(boost::multiprecision::cpp_int const& sqrt, boost::multiprecision::cpp_int const& value) {
 	if (sqrt * sqrt > value || (sqrt + 1) * (sqrt + 1) <= value) {
@@ -13,19 +21,51 @@ static bool CheckSqrtBench(boost::multiprecision::cpp_int const& sqrt, boost::mu
 	return true;
 }
 
-template <size_t Bits, size_t Length, template <typename> typename Sqrt>
-void BenchSqrt(benchmark::State &state) {
-	std::vector<tInt<Bits>> vec(100000);
-	std::vector<tInt<Bits>> res(100000);
-	boost::random::independent_bits_engine<boost::random::mt19937, Length, cpp_int> gen;
-	for (auto &v : vec) {
-		v = tInt<Bits>(gen());
+// working sets that fit into L1, L2, LLC and the one that spills to DRAM
+const std::vector<size_t> WorkingSetBytes = {16 << 10, 256 << 10, 8 << 20, 256 << 20};
+
+static void ApplyWorkingSets(benchmark::internal::Benchmark* b, size_t inputBytes, const std::vector<size_t>& workingSets) {
+	for (size_t bytes : workingSets) {
+		b->Arg(std::max<size_t>(1, bytes / inputBytes));
 	}
-	size_t i = 0;
-	for (auto _ : state) {
-		res[i] = Sqrt<tInt<Bits>>().Sqrt(vec[i]);
-		if (++i >= vec.size()) {
-			i = 0;
+	b->ArgName("inputs");
+}
+
+// Every timed batch is one pass over all the inputs in this order, so the whole working set is touched.
+// The order is shuffled, so the prefetcher can't hide the misses of LLC and DRAM sized sets
+static std::vector<uint32_t> ShuffledOrder(size_t inputs) {
+	std::vector<uint32_t> order(inputs);
+	std::iota(order.begin(), order.end(), 0u);
+	std::shuffle(order.begin(), order.end(), std::mt19937());
+	return order;
+}
+
+// fixed width values are stored inline, so keep them in one cache line aligned block
+template <typename T>
+using tAlignedVector = std::vector<T, boost::alignment::aligned_allocator<T, 64>>;
+
+// bytes touched per input for the input value and its result
+template <size_t Bits>
+constexpr size_t FixedInputBytes() {
+	return 2 * sizeof(tInt<Bits>);
+}
+
+// arbitrary values keep limbs on the heap, so this is only an estimate
+template <typename T, size_t Length>
+constexpr size_t ArbitraryInputBytes() {
+	return 2 * sizeof(T) + Length / 8 + Length / 16;
+}
+
+template <size_t Bits, size_t Length, template <typename> typename Sqrt>
+void BenchSqrt(benchmark::State &state, Distribution dist) {
+	size_t inputs = state.range(0);
+	tAlignedVector<tInt<Bits>> vec(inputs);
+	tAlignedVector<tInt<Bits>> res(inputs);
+	FillDistribution<tInt<Bits>, cpp_int, Length>(vec, dist);
+	std::vector<uint32_t> order = ShuffledOrder(inputs);
+	while (state.KeepRunningBatch(inputs)) {
+		for (uint32_t i : order) {
+			res[i] = Sqrt<tInt<Bits>>().Sqrt(vec[i]);
 		}
 	}
 	/*for (size_t i = 0; i < vec.size(); i++) { 
@@ -35,23 +75,69 @@ void BenchSqrt(benchmark::State &state) {
 	}*/
 	BENCHMARK_UNUSED(res);
 	BENCHMARK_UNUSED(vec);
+	state.counters["bytes_touched"] = static_cast<double>(inputs * FixedInputBytes<Bits>());
+}
+
+// assembles a built-in wide integer from 64-bit chunks, so cpp_int stays out of the benchmarked loop
+template <typename T, size_t Bits>
+T FromCppInt(const cpp_int &value) {
+	T res = 0;
+	for (size_t i = 0; i < Bits; i += 64) {
+		res |= static_cast<T>(static_cast<uint64_t>((value >> i) & std::numeric_limits<uint64_t>::max())) << i;
+	}
+	return res;
+}
+
+template <typename T, size_t Bits, size_t Length>
+void BenchBuiltinSqrt(benchmark::State &state) {
+	size_t inputs = state.range(0);
+	tAlignedVector<T> vec(inputs);
+	tAlignedVector<T> res(inputs);
+	boost::random::independent_bits_engine<boost::random::mt19937, Length, cpp_int> gen;
+	for (auto &v : vec) {
+		v = FromCppInt<T, Bits>(gen());
+	}
+	std::vector<uint32_t> order = ShuffledOrder(inputs);
+	while (state.KeepRunningBatch(inputs)) {
+		for (uint32_t i : order) {
+			res[i] = MathSqrt<T>().Sqrt(vec[i]);
+		}
+	}
+	BENCHMARK_UNUSED(res);
+	state.counters["bytes_touched"] = static_cast<double>(inputs * 2 * sizeof(T));
 }
 
 template <typename T, size_t Length, typename F>
-void BenchArbitrarySqrt(benchmark::State &state, F f) {
-	std::vector<T> vec(100000);
-	std::vector<T> res(100000);
+void BenchArbitrarySqrt(benchmark::State &state, F f, Distribution dist) {
+	size_t inputs = state.range(0);
+	std::optional<ArenaInputScope> inputScope;
+	if constexpr (std::is_same<T, arenaInt>::value) {
+		inputScope.emplace(inputs * ArbitraryInputBytes<T, Length>());
+	}
+	std::vector<T> vec(inputs);
+	std::vector<T> res(inputs);
     if constexpr (std::is_same<T, mpz_int>::value) {
-	    FillRandom<T, mpz_int, Length>(vec);
+	    FillDistribution<T, mpz_int, Length>(vec, dist);
     }
     else {
-	    FillRandom<T, cpp_int, Length>(vec);
+	    FillDistribution<T, cpp_int, Length>(vec, dist);
     }
-	size_t i = 0;
-	for (auto _ : state) {
-		res[i] = f(vec[i]);
-		if (++i >= vec.size()) {
-			i = 0;
+	size_t fallbacks = 0;
+	if constexpr (std::is_same<T, arenaInt>::value) {
+		fallbacks = ThreadArena::Get().Fallbacks();
+	}
+	std::vector<uint32_t> order = ShuffledOrder(inputs);
+	while (state.KeepRunningBatch(inputs)) {
+		for (uint32_t i : order) {
+			if constexpr (std::is_same<T, arenaInt>::value) {
+				// like a request handler, the result and all temporaries are dropped together
+				ArenaScope scope;
+				T r = f(vec[i]);
+				benchmark::DoNotOptimize(r);
+			}
+			else {
+				res[i] = f(vec[i]);
+			}
 		}
 	}
 	/*for (size_t i = 0; i < vec.size(); i++) { 
@@ -59,50 +145,77 @@ void BenchArbitrarySqrt(benchmark::State &state, F f) {
 			CheckSqrtBench(res[i], vec[i]);
 		}
 	}*/
+	state.counters["bytes_touched"] = static_cast<double>(inputs * ArbitraryInputBytes<T, Length>());
+	if constexpr (std::is_same<T, arenaInt>::value) {
+		state.counters["arena_fallbacks"] = static_cast<double>(ThreadArena::Get().Fallbacks() - fallbacks);
+	}
+}
+
+// uniform inputs keep the old names, other distributions are added as a suffix
+static std::string DistributionSuffix(Distribution dist) {
+	return dist == Distribution::Uniform ? "" : "_" + DistributionName(dist);
 }
 
 template <typename T, size_t Length, typename F>
-void RegisterArbitraryOne(const std::string &name, F f) {
-	std::string testName = name + "_" + std::to_string(Length);
-	benchmark::RegisterBenchmark(testName.c_str(), [f](benchmark::State &state) {
-		BenchArbitrarySqrt<T, Length, F>(state, f);
+void RegisterArbitraryOne(const std::string &name, F f, Distribution dist, const std::vector<size_t>& workingSets) {
+	std::string testName = name + "_" + std::to_string(Length) + DistributionSuffix(dist);
+	auto b = benchmark::RegisterBenchmark(testName.c_str(), [f, dist](benchmark::State &state) {
+		BenchArbitrarySqrt<T, Length, F>(state, f, dist);
 	});
+	ApplyWorkingSets(b, ArbitraryInputBytes<T, Length>(), workingSets);
 }
 
 template <typename T, typename F, size_t... Lengths>
-void RegisterArbitraryIter(const std::string &name, F f) {
-	(RegisterArbitraryOne<T, Lengths, F>(name, f), ...);
+void RegisterArbitraryIter(const std::string &name, F f, Distribution dist, const std::vector<size_t>& workingSets) {
+	(RegisterArbitraryOne<T, Lengths, F>(name, f, dist, workingSets), ...);
 }
 
 template <typename T, typename F>
-void RegisterArbitrary(const std::string &name, F f) {
-    RegisterArbitraryIter<T, F, 32, 64, 96, 128, 256, 512, 1024, 8192/*, 65536*/>(name, f);
+void RegisterArbitrary(const std::string &name, F f, Distribution dist = Distribution::Uniform, const std::vector<size_t>& workingSets = WorkingSetBytes) {
+    RegisterArbitraryIter<T, F, 32, 64, 96, 128, 256, 512, 1024, 8192/*, 65536*/>(name, f, dist, workingSets);
 }
 
 template <size_t Bits, size_t Length, template <typename> typename Sqrt>
-void RegisterOne(const std::string &name) {
-	std::string testName = name + "_" + std::to_string(Bits) + "_" + std::to_string(Length);
-	benchmark::RegisterBenchmark(testName.c_str(), [](benchmark::State &state) {
-		BenchSqrt<Bits, Length, Sqrt>(state);
+void RegisterOne(const std::string &name, Distribution dist, const std::vector<size_t>& workingSets) {
+	std::string testName = name + "_" + std::to_string(Bits) + "_" + std::to_string(Length) + DistributionSuffix(dist);
+	auto b = benchmark::RegisterBenchmark(testName.c_str(), [dist](benchmark::State &state) {
+		BenchSqrt<Bits, Length, Sqrt>(state, dist);
 	});
+	ApplyWorkingSets(b, FixedInputBytes<Bits>(), workingSets);
 }
 
 template <size_t Bits, template <typename> typename Sqrt>
-void RegisterSingle(const std::string &name) {
+void RegisterSingle(const std::string &name, Distribution dist, const std::vector<size_t>& workingSets) {
     if (Bits > 32) {
-        RegisterOne<Bits, Bits / 2, Sqrt>(name);
+        RegisterOne<Bits, Bits / 2, Sqrt>(name, dist, workingSets);
     }
-    RegisterOne<Bits, Bits, Sqrt>(name);
+    RegisterOne<Bits, Bits, Sqrt>(name, dist, workingSets);
 }
 
 template <template <typename> typename Sqrt, size_t... T>
-void RegisterIter(const std::string &name) {
-	(RegisterSingle<T, Sqrt>(name), ...);
+void RegisterIter(const std::string &name, Distribution dist, const std::vector<size_t>& workingSets) {
+	(RegisterSingle<T, Sqrt>(name, dist, workingSets), ...);
+}
+
+template <typename T, size_t Bits, size_t Length>
+void RegisterBuiltinOne(const std::string &name) {
+	std::string testName = name + "_" + std::to_string(Bits) + "_" + std::to_string(Length);
+	auto b = benchmark::RegisterBenchmark(testName.c_str(), [](benchmark::State &state) {
+		BenchBuiltinSqrt<T, Bits, Length>(state);
+	});
+	ApplyWorkingSets(b, 2 * sizeof(T), WorkingSetBytes);
+}
+
+// built-in wide types, names match the tInt benchmarks of the same width
+template <typename T, size_t Bits>
+void RegisterBuiltin(const std::string &name) {
+	RegisterBuiltinOne<T, Bits, Bits / 2>(name);
+	RegisterBuiltinOne<T, Bits, Bits>(name);
 }
 
 template <template <typename> typename Sqrt>
-void Register(const std::string &name) {
-	RegisterIter<Sqrt, 32, 64, 96, 128, 256, 512, 1024, 8192/*, 65536*/>(name);
+void Register(const std::string &name, Distribution dist = Distribution::Uniform, const std::vector<size_t>& workingSets = WorkingSetBytes) {
+	RegisterIter<Sqrt, 32, 64, 96, 128, 256, 512, 1024, 8192/*, 65536*/>(name, dist, workingSets);
 }
 
 template <typename T>
@@ -133,6 +246,20 @@ struct Karatsuba {
 	}
 };
 
+template <>
+struct Karatsuba<tInt<128>> {
+	tInt<128> Sqrt(const tInt<128> &v) {
+		return limb_sqrt(v);
+	}
+};
+
+template <>
+struct Karatsuba<tInt<256>> {
+	tInt<256> Sqrt(const tInt<256> &v) {
+		return limb_sqrt(v);
+	}
+};
+
 template<template<typename> typename Sqrt, typename T>
 T CallSqrt(const T& t) {
     return Sqrt<T>().Sqrt(t);
@@ -143,10 +270,33 @@ void RegisterSqrt() {
     Register<BoostSqrt>("Boost Fixed");
     Register<NewtonSqrt>("Newton Fixed");
     Register<Karatsuba>("Final Fixed");
+    RegisterBuiltin<uint128, 128>("Builtin Fixed");
+#if defined(__clang__) && defined(__BITINT_MAXWIDTH__)
+    RegisterBuiltin<unsigned _BitInt(192), 192>("Builtin Fixed");
+    RegisterBuiltin<unsigned _BitInt(256), 256>("Builtin Fixed");
+#endif
     RegisterArbitrary<cpp_int>("Boost Copy Arbitrary", [](const auto& v) { return v; });
     RegisterArbitrary<mpz_int>("GMP Copy Arbitrary", [](const auto& v) { return v; });
     RegisterArbitrary<cpp_int>("Boost Arbitrary", [](const auto& v) { return sqrt(v); });
     RegisterArbitrary<cpp_int>("Final Arbitrary", [](const auto& v) { return bmp_2_sqrt(v); });
+    RegisterArbitrary<cpp_int>("Kar Arbitrary", [](const auto& v) { return kar_sqrt(v); });
+    RegisterArbitrary<cpp_int>("Kar Rem Arbitrary", [](const auto& v) { cpp_int r; return kar_sqrt(v, r); });
     RegisterArbitrary<mpz_int>("GMP Arbitrary", [](const auto& v) { return sqrt(v); });
+    RegisterArbitrary<arenaInt>("Boost Arena Arbitrary", [](const auto& v) { return sqrt(v); });
+    RegisterArbitrary<arenaInt>("Final Arena Arbitrary", [](const auto& v) { return bmp_2_sqrt(v); });
+    RegisterArbitrary<arenaInt>("Kar Arena Arbitrary", [](const auto& v) { return kar_sqrt(v); });
     //Register<Karatsuba>("Final Fixed");
 }
+
+void RegisterDistribution() {
+	// branch behaviour doesn't depend on the memory footprint, so L2 sized working set is enough
+	const std::vector<size_t> workingSets = {256 << 10};
+	for (Distribution dist : AllDistributions) {
+		Register<BoostSqrt>("Boost Fixed", dist, workingSets);
+		Register<NewtonSqrt>("Newton Fixed", dist, workingSets);
+		Register<Karatsuba>("Final Fixed", dist, workingSets);
+		RegisterArbitrary<cpp_int>("Boost Arbitrary", [](const auto& v) { return sqrt(v); }, dist, workingSets);
+		RegisterArbitrary<cpp_int>("Final Arbitrary", [](const auto& v) { return bmp_2_sqrt(v); }, dist, workingSets);
+		RegisterArbitrary<mpz_int>("GMP Arbitrary", [](const auto& v) { return sqrt(v); }, dist, workingSets);
+	}
+}
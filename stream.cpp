@@ -0,0 +1,56 @@
+#include <iostream>
+#include "stream.h"
+
+static void Usage() {
+	std::cout << "Usage sqrt_stream gen (bin|hex) <output> <count> <bits>" << std::endl;
+	std::cout << "      sqrt_stream run (bin|hex) <input> <output> [threads] [batch]" << std::endl;
+}
+
+template <size_t... Lengths>
+static bool Generate(StreamFormat format, std::ostream& out, size_t count, size_t bits) {
+	return ((bits == Lengths && (GenerateStream<Lengths>(format, out, count), true)) || ...);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 5 || (std::string(argv[2]) != "bin" && std::string(argv[2]) != "hex")) {
+		Usage();
+		return 0;
+	}
+	StreamFormat format = std::string(argv[2]) == "bin" ? StreamFormat::Binary : StreamFormat::Hex;
+	if (std::string(argv[1]) == "gen" && argc == 6) {
+		std::ofstream out(argv[3], std::ios::binary);
+		if (!out) {
+			std::cerr << "sqrt_stream: can't open " << argv[3] << std::endl;
+			return 1;
+		}
+		size_t count = std::stoull(argv[4]);
+		size_t bits = std::stoull(argv[5]);
+		if (!Generate<32, 64, 96, 128, 256, 512, 1024, 8192>(format, out, count, bits)) {
+			std::cout << "bits should be one of 32, 64, 96, 128, 256, 512, 1024, 8192" << std::endl;
+			return 1;
+		}
+	}
+	else if (std::string(argv[1]) == "run") {
+		size_t threads = argc > 5 ? std::stoull(argv[5]) : std::max(1u, std::thread::hardware_concurrency());
+		size_t batch = argc > 6 ? std::stoull(argv[6]) : 1024;
+		if (threads == 0 || batch == 0) {
+			Usage();
+			return 1;
+		}
+		try {
+			StreamStats stats = StreamSqrt(format, argv[3], argv[4], threads, batch);
+			std::cout << stats.count << " values, " << stats.bytes << " bytes in " << stats.seconds << " s, "
+				<< stats.bytes / stats.seconds / 1e9 << " GB/s" << std::endl;
+		}
+		catch (const std::exception& e) {
+			std::cerr << "sqrt_stream: " << e.what() << std::endl;
+			return 1;
+		}
+#ifdef SQRT_INSTRUMENT
+		SqrtStats::Dump(std::cout);
+#endif
+	}
+	else {
+		Usage();
+	}
+}
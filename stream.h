@@ -0,0 +1,411 @@
+#pragma once
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "karatsuba.h"
+
+// Input/output files are either:
+//   bin - records of a little-endian uint64_t limb count followed by that many little-endian uint64_t limbs
+//   hex - one lowercase or uppercase hex number per line, without prefix
+// Output has a root and a remainder for every radicand: two bin records, or one "root remainder" hex line
+enum class StreamFormat {
+	Binary,
+	Hex,
+};
+
+static_assert(sizeof(limb_type) == sizeof(uint64_t), "stream format expects 64-bit limbs");
+
+class MappedFile {
+public:
+	explicit MappedFile(const std::string& path) {
+		m_fd = open(path.c_str(), O_RDONLY);
+		if (m_fd < 0) {
+			throw std::runtime_error("can't open " + path);
+		}
+		struct stat st;
+		if (fstat(m_fd, &st) != 0) {
+			close(m_fd);
+			throw std::runtime_error("can't stat " + path);
+		}
+		m_size = static_cast<size_t>(st.st_size);
+		if (m_size > 0) {
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+			if (data == MAP_FAILED) {
+				close(m_fd);
+				throw std::runtime_error("can't mmap " + path);
+			}
+			// we read the file once from begin to end
+			madvise(data, m_size, MADV_SEQUENTIAL);
+			m_data = static_cast<const char*>(data);
+		}
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile() {
+		if (m_data) {
+			munmap(const_cast<char*>(m_data), m_size);
+		}
+		close(m_fd);
+	}
+
+	const char* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+
+private:
+	int m_fd = -1;
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+// Blocking FIFO with fixed capacity, Pop returns false when the queue is closed and drained
+template<typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(size_t capacity) : m_capacity(capacity) {}
+
+	void Push(T value) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [this] { return m_queue.size() < m_capacity; });
+		m_queue.push_back(std::move(value));
+		m_notEmpty.notify_one();
+	}
+
+	bool Pop(T& value) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [this] { return !m_queue.empty() || m_closed; });
+		if (m_queue.empty()) {
+			return false;
+		}
+		value = std::move(m_queue.front());
+		m_queue.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	void Close() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notEmpty.notify_all();
+	}
+
+private:
+	const size_t m_capacity;
+	std::deque<T> m_queue;
+	bool m_closed = false;
+	std::mutex m_mutex;
+	std::condition_variable m_notEmpty;
+	std::condition_variable m_notFull;
+};
+
+// Keeps batch outputs in input order: batch `id` can be stored only when it's less than
+// `capacity` batches ahead of the writer, so at most `capacity` outputs are in memory.
+// The producer closes the sink with the number of batches once the last one is dispatched
+class OrderedSink {
+public:
+	explicit OrderedSink(size_t capacity) : m_slots(capacity), m_ready(capacity, false) {}
+
+	void Put(size_t id, std::string data) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_cv.wait(lock, [this, id] { return id < m_next + m_slots.size(); });
+		m_slots[id % m_slots.size()] = std::move(data);
+		m_ready[id % m_slots.size()] = true;
+		m_cv.notify_all();
+	}
+
+	// returns false when the sink is closed and all the batches were taken
+	bool Take(std::string& data) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		size_t slot = m_next % m_slots.size();
+		m_cv.wait(lock, [this, slot] { return m_ready[slot] || (m_closed && m_next >= m_total); });
+		if (!m_ready[slot]) {
+			return false;
+		}
+		data = std::move(m_slots[slot]);
+		m_ready[slot] = false;
+		m_next++;
+		m_cv.notify_all();
+		return true;
+	}
+
+	void Close(size_t total) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_total = total;
+		m_closed = true;
+		m_cv.notify_all();
+	}
+
+private:
+	std::vector<std::string> m_slots;
+	std::vector<bool> m_ready;
+	size_t m_next = 0;
+	size_t m_total = 0;
+	bool m_closed = false;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+};
+
+struct StreamBatch {
+	size_t id;
+	const char* begin;
+	const char* end;
+};
+
+inline int HexDigit(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Reads limbs straight from the mapped record into the backend storage
+template<class Integer>
+const char* ParseBinary(const char* pos, Integer& value) {
+	uint64_t size;
+	std::memcpy(&size, pos, sizeof(size));
+	pos += sizeof(size);
+	value = 0u;
+	if (size > 0) {
+		value.backend().resize(static_cast<unsigned>(size), static_cast<unsigned>(size));
+		std::memcpy(value.backend().limbs(), pos, size * sizeof(limb_type));
+		value.backend().normalize();
+	}
+	return pos + size * sizeof(limb_type);
+}
+
+// Packs hex digits from the end of the line into limbs without building an intermediate string
+template<class Integer>
+const char* ParseHex(const char* pos, const char* end, Integer& value) {
+	const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+	if (!lineEnd) {
+		lineEnd = end;
+	}
+	const char* last = lineEnd;
+	while (last > pos && std::isspace(static_cast<unsigned char>(last[-1]))) last--;
+	while (pos < last && std::isspace(static_cast<unsigned char>(*pos))) pos++;
+	for (const char* c = pos; c < last; c++) {
+		if (HexDigit(*c) < 0) {
+			throw std::runtime_error("invalid hex digit '" + std::string(1, *c) + "'");
+		}
+	}
+	constexpr size_t digitsPerLimb = sizeof(limb_type) * 2;
+	size_t digits = last - pos;
+	size_t size = (digits + digitsPerLimb - 1) / digitsPerLimb;
+	value = 0u;
+	if (size > 0) {
+		value.backend().resize(static_cast<unsigned>(size), static_cast<unsigned>(size));
+		limb_type* limbs = value.backend().limbs();
+		for (size_t i = 0; i < size; i++) {
+			limb_type limb = 0;
+			const char* from = last > pos + digitsPerLimb ? last - digitsPerLimb : pos;
+			for (const char* c = from; c < last; c++) {
+				limb = (limb << 4) | static_cast<limb_type>(HexDigit(*c));
+			}
+			limbs[i] = limb;
+			last = from;
+		}
+		value.backend().normalize();
+	}
+	return lineEnd < end ? lineEnd + 1 : end;
+}
+
+template<class Integer>
+void WriteBinary(std::string& out, const Integer& value) {
+	uint64_t size = value.is_zero() ? 0 : value.backend().size();
+	out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+	out.append(reinterpret_cast<const char*>(value.backend().limbs()), size * sizeof(limb_type));
+}
+
+template<class Integer>
+void WriteHex(std::string& out, const Integer& value) {
+	static const char digits[] = "0123456789abcdef";
+	if (value.is_zero()) {
+		out.push_back('0');
+		return;
+	}
+	const limb_type* limbs = value.backend().limbs();
+	size_t size = value.backend().size();
+	bool leading = true;
+	for (size_t i = size; i-- > 0;) {
+		for (int shift = sizeof(limb_type) * 8 - 4; shift >= 0; shift -= 4) {
+			unsigned digit = static_cast<unsigned>(limbs[i] >> shift) & 0xf;
+			if (leading && digit == 0) continue;
+			leading = false;
+			out.push_back(digits[digit]);
+		}
+	}
+}
+
+struct StreamStats {
+	size_t count;
+	size_t bytes;
+	double seconds;
+};
+
+template<class Integer>
+void ProcessBatch(StreamFormat format, const StreamBatch& batch, std::string& out) {
+	Integer x, s, r;
+	const char* pos = batch.begin;
+	while (pos < batch.end) {
+		if (format == StreamFormat::Binary) {
+			pos = ParseBinary(pos, x);
+		}
+		else {
+			pos = ParseHex(pos, batch.end, x);
+		}
+		s = kar_sqrt(x, r);
+		if (format == StreamFormat::Binary) {
+			WriteBinary(out, s);
+			WriteBinary(out, r);
+		}
+		else {
+			WriteHex(out, s);
+			out.push_back(' ');
+			WriteHex(out, r);
+			out.push_back('\n');
+		}
+	}
+}
+
+// Cuts up to `batchSize` records starting from `pos`, returns the end of the last record
+inline const char* NextBatchEnd(StreamFormat format, const char* pos, const char* end, size_t batchSize, size_t& records) {
+	for (records = 0; records < batchSize && pos < end; records++) {
+		if (format == StreamFormat::Binary) {
+			uint64_t size;
+			if (static_cast<size_t>(end - pos) < sizeof(size)) {
+				throw std::runtime_error("truncated record");
+			}
+			std::memcpy(&size, pos, sizeof(size));
+			if (size > static_cast<size_t>(end - pos - sizeof(size)) / sizeof(limb_type)) {
+				throw std::runtime_error("truncated record");
+			}
+			pos += sizeof(size) + size * sizeof(limb_type);
+		}
+		else {
+			const char* lineEnd = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+			pos = lineEnd ? lineEnd + 1 : end;
+		}
+	}
+	return pos;
+}
+
+// The main thread cuts the mapped file into batches, `threads` workers take roots of them,
+// and a single writer flushes the results in input order. The first error stops dispatching,
+// and is rethrown once all the threads are joined
+template<class Integer = cpp_int>
+StreamStats StreamSqrt(StreamFormat format, const std::string& input, const std::string& output, size_t threads, size_t batchSize) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file(input);
+	const char* end = file.Data() + file.Size();
+
+	BoundedQueue<StreamBatch> batches(threads * 2);
+	OrderedSink sink(threads * 4);
+
+	std::ofstream out(output, std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("can't open " + output);
+	}
+	std::thread writer([&] {
+		std::string data;
+		while (sink.Take(data)) {
+			out.write(data.data(), data.size());
+		}
+	});
+
+	std::mutex errorMutex;
+	std::exception_ptr error;
+	std::atomic<bool> failed{false};
+	auto fail = [&] {
+		std::lock_guard<std::mutex> lock(errorMutex);
+		if (!error) {
+			error = std::current_exception();
+		}
+		failed = true;
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < threads; i++) {
+		workers.emplace_back([&] {
+			StreamBatch batch;
+			while (batches.Pop(batch)) {
+				std::string data;
+				try {
+					ProcessBatch<Integer>(format, batch, data);
+				}
+				catch (...) {
+					fail();
+				}
+				// the writer waits for every dispatched batch, even the failed ones
+				sink.Put(batch.id, std::move(data));
+			}
+		});
+	}
+
+	// batches are counted while they're dispatched, so the file is read only once
+	size_t id = 0;
+	size_t totalRecords = 0;
+	try {
+		for (const char* pos = file.Data(); pos < end && !failed; id++) {
+			size_t records;
+			const char* next = NextBatchEnd(format, pos, end, batchSize, records);
+			batches.Push(StreamBatch{id, pos, next});
+			totalRecords += records;
+			pos = next;
+		}
+	}
+	catch (...) {
+		fail();
+	}
+	batches.Close();
+	sink.Close(id);
+	for (auto& w : workers) {
+		w.join();
+	}
+	writer.join();
+	if (error) {
+		std::rethrow_exception(error);
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return StreamStats{totalRecords, file.Size(), elapsed.count()};
+}
+
+template<size_t Length>
+void GenerateStream(StreamFormat format, std::ostream& out, size_t count) {
+	// generate in chunks, so we don't keep all the file in memory
+	const size_t chunk = 4096;
+	std::vector<cpp_int> v;
+	std::string data;
+	for (size_t done = 0; done < count; done += chunk) {
+		v.resize(std::min(chunk, count - done));
+		// every chunk gets its own seed, the first one matches the benchmark inputs
+		FillRandom<cpp_int, cpp_int, Length>(v, boost::random::mt19937::default_seed + done / chunk);
+		data.clear();
+		for (const auto& i : v) {
+			if (format == StreamFormat::Binary) {
+				WriteBinary(data, i);
+			}
+			else {
+				WriteHex(data, i);
+				data.push_back('\n');
+			}
+		}
+		out.write(data.data(), data.size());
+	}
+}
@@ -3,6 +3,10 @@
 #include "newton.h"
 #include "karatsuba.h"
 #include "karatsubapr.h"
+#include "arena.h"
+#include "cache.h"
+#include <atomic>
+#include <thread>
 
 template <class tInt>
 tInt IntSqrt(tInt const& n) {
@@ -99,3 +103,202 @@ BOOST_AUTO_TEST_CASE(TestSegments) {
 		if (PrintProgress && i % 10000 == 0) std::cout << i / 1000 << std::endl;
 	}
 }
+
+template<unsigned Bits>
+static void TestNewtonDistribution() {
+	for (Distribution dist : AllDistributions) {
+		std::vector<tInt<Bits>> values(1000);
+		FillDistribution<tInt<Bits>, boost::multiprecision::cpp_int, Bits>(values, dist);
+		for (const auto& v : values) {
+			boost::multiprecision::cpp_int sqrt(NewtonSqrt<tInt<Bits>>().Sqrt(v));
+			CheckSqrt<boost::multiprecision::cpp_int>(sqrt, boost::multiprecision::cpp_int(v));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TestNewtonDistributions) {
+	TestNewtonDistribution<32>();
+	TestNewtonDistribution<64>();
+	TestNewtonDistribution<96>();
+	TestNewtonDistribution<128>();
+	TestNewtonDistribution<192>();
+	TestNewtonDistribution<256>();
+	TestNewtonDistribution<512>();
+	TestNewtonDistribution<1024>();
+	TestNewtonDistribution<8192>();
+}
+
+template<unsigned Bits>
+static void CheckLimbSqrt(boost::multiprecision::cpp_int const& value) {
+	tInt<Bits> r;
+	tInt<Bits> s = limb_sqrt(tInt<Bits>(value), r);
+	boost::multiprecision::cpp_int rem;
+	boost::multiprecision::cpp_int sqrt = bmp_sqrt(value, rem);
+	BOOST_CHECK_EQUAL(boost::multiprecision::cpp_int(s), sqrt);
+	BOOST_CHECK_EQUAL(boost::multiprecision::cpp_int(r), rem);
+}
+
+template<unsigned Bits>
+static void TestLimbKernel() {
+	boost::random::independent_bits_engine<boost::random::mt19937, Bits, boost::multiprecision::cpp_int> gen;
+	for (unsigned len = 1; len <= Bits; len++) {
+		boost::multiprecision::cpp_int max = (boost::multiprecision::cpp_int(1) << len) - 1;
+		boost::multiprecision::cpp_int root = max >> (len - len / 2);
+		CheckLimbSqrt<Bits>(max);
+		CheckLimbSqrt<Bits>(max >> 1);
+		CheckLimbSqrt<Bits>(root * root);
+		CheckLimbSqrt<Bits>(root * root + 1);
+		if (root > 1) CheckLimbSqrt<Bits>(root * root - 1);
+		for (int i = 0; i < 100; i++) {
+			CheckLimbSqrt<Bits>(gen() >> (Bits - len));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TestLimbKernels) {
+	TestLimbKernel<64>();
+	TestLimbKernel<128>();
+	TestLimbKernel<192>();
+	TestLimbKernel<256>();
+}
+
+BOOST_AUTO_TEST_CASE(TestBuiltinWide) {
+	boost::random::independent_bits_engine<boost::random::mt19937, 128, boost::multiprecision::cpp_int> gen;
+	for (unsigned len = 1; len <= 128; len++) {
+		for (int i = 0; i < 100; i++) {
+			boost::multiprecision::cpp_int value = gen() >> (128 - len);
+			if (i == 0) value = (boost::multiprecision::cpp_int(1) << len) - 1;
+			unsigned __int128 r;
+			unsigned __int128 s = MathSqrt<unsigned __int128>().SqrtRem(value.convert_to<unsigned __int128>(), r);
+			boost::multiprecision::cpp_int rem;
+			BOOST_CHECK_EQUAL(boost::multiprecision::cpp_int(s), bmp_sqrt(value, rem));
+			BOOST_CHECK_EQUAL(boost::multiprecision::cpp_int(r), rem);
+		}
+	}
+}
+
+#if defined(__clang__) && defined(__BITINT_MAXWIDTH__)
+template<unsigned N>
+static void TestBitIntWidth() {
+	using Int = unsigned _BitInt(N);
+	boost::random::independent_bits_engine<boost::random::mt19937, N, boost::multiprecision::cpp_int> gen;
+	for (unsigned len = 1; len <= N; len++) {
+		for (int i = 0; i < 20; i++) {
+			boost::multiprecision::cpp_int value = gen() >> (N - len);
+			if (i == 0) value = (boost::multiprecision::cpp_int(1) << len) - 1;
+			Int x = 0;
+			for (unsigned k = 0; k < N; k += 64) {
+				x |= static_cast<Int>(static_cast<uint64_t>((value >> k) & std::numeric_limits<uint64_t>::max())) << k;
+			}
+			Int r;
+			Int s = MathSqrt<Int>().SqrtRem(x, r);
+			boost::multiprecision::cpp_int sqrt = 0, rem = 0;
+			for (unsigned k = 0; k < N; k += 64) {
+				sqrt |= boost::multiprecision::cpp_int(static_cast<uint64_t>(s >> k)) << k;
+				rem |= boost::multiprecision::cpp_int(static_cast<uint64_t>(r >> k)) << k;
+			}
+			boost::multiprecision::cpp_int expectedRem;
+			BOOST_CHECK_EQUAL(sqrt, bmp_sqrt(value, expectedRem));
+			BOOST_CHECK_EQUAL(rem, expectedRem);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TestBitInt) {
+	TestBitIntWidth<64>();
+	TestBitIntWidth<128>();
+	TestBitIntWidth<192>();
+	TestBitIntWidth<256>();
+}
+#endif
+
+template<typename Int, size_t Length>
+static void TestRootOnlyLength() {
+	std::vector<Int> values(2000);
+	for (Distribution dist : AllDistributions) {
+		FillDistribution<Int, boost::multiprecision::cpp_int, Length>(values, dist);
+		for (const auto& v : values) {
+			Int r;
+			BOOST_CHECK_EQUAL(kar_sqrt(v), kar_sqrt(v, r));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TestRootOnly) {
+	TestRootOnlyLength<tInt<128>, 128>();
+	TestRootOnlyLength<tInt<256>, 256>();
+	TestRootOnlyLength<tInt<1024>, 1024>();
+	TestRootOnlyLength<boost::multiprecision::cpp_int, 96>();
+	TestRootOnlyLength<boost::multiprecision::cpp_int, 512>();
+	TestRootOnlyLength<boost::multiprecision::cpp_int, 8192>();
+}
+
+BOOST_AUTO_TEST_CASE(TestArena) {
+	ArenaScope testScope;
+	std::vector<arenaInt> values(1000);
+	FillRandom<arenaInt, boost::multiprecision::cpp_int, 2048>(values);
+	size_t mark = ThreadArena::Get().Mark();
+	for (const auto& v : values) {
+		ArenaScope scope;
+		arenaInt r;
+		arenaInt s = kar_sqrt(v, r);
+		BOOST_CHECK_EQUAL(s * s + r, v);
+		BOOST_CHECK_LE(r, 2 * s);
+		BOOST_CHECK_EQUAL(bmp_2_sqrt(v), s);
+	}
+	BOOST_CHECK_EQUAL(ThreadArena::Get().Mark(), mark);
+}
+
+BOOST_AUTO_TEST_CASE(TestArenaInputScope) {
+	ThreadArena& arena = ThreadArena::Get();
+	{
+		ArenaInputScope scope(4 << 20);
+		void* p = arena.Allocate(4 << 20, alignof(limb_type));
+		BOOST_CHECK(arena.Owns(p));
+	}
+	BOOST_CHECK_EQUAL(arena.Mark(), 0u);
+	// the grown buffer is given back, so the same allocation doesn't fit anymore
+	size_t fallbacks = arena.Fallbacks();
+	void* p = arena.Allocate(4 << 20, alignof(limb_type));
+	BOOST_CHECK(!arena.Owns(p));
+	BOOST_CHECK_EQUAL(arena.Fallbacks(), fallbacks + 1);
+	arena.Deallocate(p);
+}
+
+template<typename Int, size_t Length, template<size_t> typename Eviction>
+static void TestCacheLength() {
+	// fewer entries than distinct values, so lookups hit, miss and evict
+	SqrtCache<Int, Eviction> cache(64, 4);
+	std::vector<Int> values(300);
+	FillRandom<Int, boost::multiprecision::cpp_int, Length>(values);
+	// Boost.Test assertions aren't thread safe, so threads only count wrong results
+	std::atomic<size_t> wrong{0};
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < 4; t++) {
+		threads.emplace_back([&cache, &values, &wrong, t] {
+			for (size_t i = 0; i < 3000; i++) {
+				// mostly a hot set of 40 values, every 7th lookup anywhere in the vector
+				const Int& v = values[i % 7 == 0 ? i % values.size() : (i * (t + 1)) % 40];
+				Int r;
+				Int s = cache.SqrtRem(v, r);
+				if (s * s + r != v || r > 2 * s) {
+					wrong++;
+				}
+			}
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+	BOOST_CHECK_EQUAL(wrong.load(), 0u);
+	SqrtCacheStats stats = cache.Stats();
+	BOOST_CHECK_EQUAL(stats.hits + stats.misses, 12000u);
+	BOOST_CHECK_GT(stats.hits, 0u);
+	BOOST_CHECK_GT(stats.evictions, 0u);
+}
+BOOST_AUTO_TEST_CASE(TestCache) {
+	TestCacheLength<tInt<128>, 128, LruEviction>();
+	TestCacheLength<tInt<256>, 256, ClockEviction>();
+	TestCacheLength<tInt<1024>, 1024, RandomEviction>();
+	TestCacheLength<boost::multiprecision::cpp_int, 512, LruEviction>();
+}